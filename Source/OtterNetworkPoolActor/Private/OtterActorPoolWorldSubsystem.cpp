@@ -5,15 +5,65 @@
 #include "Stats/StatsMisc.h"
 #include "Net/UnrealNetwork.h"
 #include "GameFramework/GameModeBase.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/Paths.h"
 #include "OtterPoolActorInterface.h"
+#include "OtterPoolSoakBenchmark.h"
 #include <bitset>
 
 constexpr uint8 MAX_ELEMENT = sizeof(uint64) * 8;
+// Cell size of the stand-in spatial hash, in cm
+constexpr double STAND_IN_CELL_SIZE = 1000.0;
+
+// Section is suffixed by the map name, [OtterPoolSizing.<Map>] in Game.ini
+static const TCHAR* SizingSection = TEXT("OtterPoolSizing");
+static const TCHAR* SizingKey = TEXT("Class");
+
+static TAutoConsoleVariable<bool> CVarWriteSizingReportOnWorldEnd(
+	TEXT("Otter.Pool.WriteSizingReportOnWorldEnd"),
+	false,
+	TEXT("Write the pool sizing report when the world end play"));
+
+static TAutoConsoleVariable<float> CVarSizingCapHeadroom(
+	TEXT("Otter.Pool.SizingCapHeadroom"),
+	1.5f,
+	TEXT("Recommended cap = peak in use * headroom, 0 to not recommend any cap"));
+
+static FAutoConsoleCommandWithWorld WriteSizingReportCommand(
+	TEXT("Otter.Pool.WriteSizingReport"),
+	TEXT("Write recommended pool warm counts and caps from this session usage"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* InWorld)
+		{
+			auto System = InWorld ? InWorld->GetSubsystem<UOtterPoolActorWorldSubsystem>() : nullptr;
+			if (!System || !System->WriteSizingReport())
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Pool: no sizing report written, command must run on server world"));
+			}
+		}));
+
+// A late joiner receive every stand-in item as changed in one update, the fast array refuse the update when it hold
+// more than net.MaxNumberOfAllowedTArrayChangesPerUpdate changes
+static int32 GetMaxStandInItems()
+{
+	static const auto MaxChangesVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("net.MaxNumberOfAllowedTArrayChangesPerUpdate"));
+	return MaxChangesVariable ? MaxChangesVariable->GetInt() : 2048;
+}
+
+static FIntVector GetStandInCell(const FVector& Location)
+{
+	return FIntVector(
+		FMath::FloorToInt32(Location.X / STAND_IN_CELL_SIZE),
+		FMath::FloorToInt32(Location.Y / STAND_IN_CELL_SIZE),
+		FMath::FloorToInt32(Location.Z / STAND_IN_CELL_SIZE));
+}
 
 void AReplicateProxyActor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty> &OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 	DOREPLIFETIME(ThisClass, ActorPools);
+	DOREPLIFETIME(ThisClass, StandIns);
 }
 
 bool UOtterPoolActorWorldSubsystem::ShouldCreateSubsystem(UObject * Outer) const
@@ -31,11 +81,89 @@ void UOtterPoolActorWorldSubsystem::OnWorldBeginPlay(UWorld & InWorld)
 	SpawnInfo.ObjectFlags |= RF_Transient;	// We never want to save game states or network managers into a map		
 	ReplicateActor = InWorld.SpawnActor<AReplicateProxyActor>(SpawnInfo);
 	ReplicateActor->bAlwaysRelevant = true;
+	// Subsystem begin play run before GameMode StartPlay, prewarmed actors would get BeginPlay from the world
+	// while idle in the pool. UWorld::OnWorldBeginPlay is broadcast once actors have begun play
+	WorldBeginPlayHandle = InWorld.OnWorldBeginPlay.AddUObject(this, &UOtterPoolActorWorldSubsystem::ApplySizingConfig);
+}
+
+FString UOtterPoolActorWorldSubsystem::GetSizingSectionName() const
+{
+	return FString::Printf(TEXT("%s.%s"), SizingSection, *UWorld::RemovePIEPrefix(GetWorld()->GetMapName()));
+}
+
+void UOtterPoolActorWorldSubsystem::ApplySizingConfig()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UOtterPoolActorWorldSubsystem::ApplySizingConfig);
+	GetWorld()->OnWorldBeginPlay.Remove(WorldBeginPlayHandle);
+	WorldBeginPlayHandle.Reset();
+	if (!IsValid(ReplicateActor))
+		return;
+	// Read from Game.ini hierarchy so the sizing is staged with DefaultGame.ini in packaged build
+	const FString Section = GetSizingSectionName();
+	TArray<FString> Lines;
+	if (!GConfig || GConfig->GetArray(*Section, SizingKey, Lines, GGameIni) == 0)
+		return;
+	for (const auto& Line : Lines)
+	{
+		FOtterPoolClassSizing Sizing;
+		if (!FOtterPoolClassSizing::StaticStruct()->ImportText(*Line, &Sizing, nullptr, PPF_None, GLog, FOtterPoolClassSizing::StaticStruct()->GetName()))
+			continue;
+		auto ActorClass = Sizing.ActorClass.LoadSynchronous();
+		if (!ActorClass)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Pool: sizing section [%s] has invalid class %s"), *Section, *Sizing.ActorClass.ToString());
+			continue;
+		}
+		ReplicateActor->ApplySizing(ActorClass, Sizing.WarmCount, Sizing.MaxCount);
+	}
+}
+
+bool UOtterPoolActorWorldSubsystem::WriteSizingReport()
+{
+	if (!IsValid(ReplicateActor))
+		return false;
+
+	const float CapHeadroom = CVarSizingCapHeadroom.GetValueOnGameThread();
+	TArray<FString> Lines;
+	for (auto& Usage : ReplicateActor->GetClassUsage())
+	{
+		if (!Usage.Key)
+			continue;
+		FOtterPoolClassSizing Sizing;
+		Sizing.ActorClass = Usage.Key;
+		Sizing.WarmCount = Usage.Value.PeakInUse;
+		Sizing.MaxCount = CapHeadroom > 0.0f ? FMath::Max(FMath::CeilToInt(Usage.Value.PeakInUse * CapHeadroom), Usage.Value.PeakInUse + 1) : 0;
+		Sizing.PeakInUse = Usage.Value.PeakInUse;
+		Sizing.NumAcquire = Usage.Value.NumAcquire;
+		Sizing.NumMiss = Usage.Value.NumMiss;
+		Sizing.NumOverCap = Usage.Value.NumOverCap;
+		Sizing.AvgSpawnMs = Usage.Value.NumMiss > 0 ? float(Usage.Value.SpawnSeconds * 1000.0 / Usage.Value.NumMiss) : 0.0f;
+
+		FString Line;
+		FOtterPoolClassSizing::StaticStruct()->ExportText(Line, &Sizing, nullptr, nullptr, PPF_None, nullptr);
+		Lines.Add(Line);
+	}
+	Lines.Sort();
+
+	// Written with the same section as read, paste it into Config/DefaultGame.ini to apply
+	const FString Section = GetSizingSectionName();
+	const FString Filename = FPaths::ProjectSavedDir() / TEXT("OtterPool") / (Section + TEXT(".ini"));
+	FConfigFile File;
+	File.SetArray(*Section, SizingKey, Lines);
+	if (!File.Write(Filename))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Pool: failed to write sizing report %s"), *Filename);
+		return false;
+	}
+	UE_LOG(LogTemp, Log, TEXT("Pool: wrote sizing report for %d class to %s"), Lines.Num(), *Filename);
+	return true;
 }
 
 void UOtterPoolActorWorldSubsystem::Deinitialize()
 {
 	Super::Deinitialize();
+	if (WorldBeginPlayHandle.IsValid())
+		GetWorld()->OnWorldBeginPlay.Remove(WorldBeginPlayHandle);
 	if (IsValid(ReplicateActor))
 		ReplicateActor->Destroy();
 }
@@ -67,20 +195,84 @@ bool UOtterPoolActorWorldSubsystem::ReleaseToPool(AActor* Actor)
 	return ReplicateActor->ReleaseToPool(Actor);
 }
 
+int32 UOtterPoolActorWorldSubsystem::AddStandIn(TSubclassOf<AActor> ActorClass, FTransform const& Transform)
+{
+	if (!IsValid(ReplicateActor))
+		return INDEX_NONE;
+	return ReplicateActor->AddStandIn(ActorClass, Transform);
+}
+
+AActor* UOtterPoolActorWorldSubsystem::PromoteStandIn(int32 Handle, AActor* Owner, APawn* Instigator)
+{
+	if (!IsValid(ReplicateActor))
+		return nullptr;
+	return ReplicateActor->PromoteStandIn(Handle, Owner, Instigator);
+}
+
+int32 UOtterPoolActorWorldSubsystem::DemoteToStandIn(AActor* Actor)
+{
+	if (!IsValid(ReplicateActor))
+		return INDEX_NONE;
+	return ReplicateActor->DemoteToStandIn(Actor);
+}
+
+bool UOtterPoolActorWorldSubsystem::RemoveStandIn(int32 Handle)
+{
+	if (!IsValid(ReplicateActor))
+		return false;
+	return ReplicateActor->RemoveStandIn(Handle);
+}
+
+int32 UOtterPoolActorWorldSubsystem::FindStandIns(TSubclassOf<AActor> ActorClass, const FVector& Location, float Radius, TArray<int32>& OutHandles) const
+{
+	if (!IsValid(ReplicateActor))
+		return 0;
+	return ReplicateActor->FindStandIns(ActorClass, Location, Radius, OutHandles);
+}
+
+int32 UOtterPoolActorWorldSubsystem::GetStandInHandle(const UPrimitiveComponent* Component, int32 InstanceIndex) const
+{
+	if (!IsValid(ReplicateActor))
+		return INDEX_NONE;
+	return ReplicateActor->GetStandInHandle(Component, InstanceIndex);
+}
+
 AReplicateProxyActor::AReplicateProxyActor()
 {
 	bReplicates = true;
 	bAlwaysRelevant = true;
 	SetNetUpdateFrequency(1000.0f);
 	NetPriority = 400;
+	// AInfo is hidden by default, stand-in instanced meshes are rendered through this actor
+	SetHidden(false);
+}
+
+void AReplicateProxyActor::PostInitProperties()
+{
+	Super::PostInitProperties();
+	ActorPools.Owner = this;
+	StandIns.Owner = this;
 }
 
 void AReplicateProxyActor::EndPlay(EEndPlayReason::Type Reason)
 {
 	Super::EndPlay(Reason);
+	for (auto& TickFunction : BatchedTickFunctions)
+	{
+		TickFunction->UnRegisterTickFunction();
+	}
+	BatchedTickFunctions.Empty();
+	StandInBatches.Empty();
+	StandInInstanceIndices.Empty();
 	if (!HasAuthority())
 		return;
 
+	if (CVarWriteSizingReportOnWorldEnd.GetValueOnGameThread() && Reason != EEndPlayReason::Destroyed)
+	{
+		if (auto System = GetWorld()->GetSubsystem<UOtterPoolActorWorldSubsystem>())
+			System->WriteSizingReport();
+	}
+
 	for (auto& ActorEntry : ActorPools.Items)
 	{
 		for (auto CacheActor : ActorEntry.CacheActors)
@@ -91,6 +283,10 @@ void AReplicateProxyActor::EndPlay(EEndPlayReason::Type Reason)
 		}
 	}
 	ActorPools.Items.Empty();
+	StandIns.Items.Empty();
+	StandInItemIndices.Empty();
+	FreeStandInItems.Empty();
+	StandInCells.Empty();
 }
 
 AActor* AReplicateProxyActor::SpawnActor(const FPoolActorSpawnParameters& SpawnParameter)
@@ -98,6 +294,7 @@ AActor* AReplicateProxyActor::SpawnActor(const FPoolActorSpawnParameters& SpawnP
 	TRACE_CPUPROFILER_EVENT_SCOPE(AReplicateProxyActor::SpawnActor);
 	if (!SpawnParameter.ActorClass)
 		return nullptr;
+	const double StartTime = FPlatformTime::Seconds();
 	FOtterActorPoolData* Found = nullptr;
 	FOtterPoolActorEntry* FoundEntry = nullptr;
 	for (auto& ActorEntry : ActorPools.Items)
@@ -110,9 +307,15 @@ AActor* AReplicateProxyActor::SpawnActor(const FPoolActorSpawnParameters& SpawnP
 			{
 				if (ActorEntry.IsFull())
 					continue;
+				if (HasReachedMaxCount(SpawnParameter.ActorClass))
+					return SpawnOverCapActor(SpawnParameter, StartTime);
 				Found = ActorEntry.SpawnActor(GetWorld(), SpawnParameter);
 				if (Found)
+				{
+					ActorPools.MarkItemDirty(ActorEntry);
+					RecordAcquire(ActorEntry, Found, true, FPlatformTime::Seconds() - StartTime);
 					return Found->Actor;
+				}
 			}
 			FoundEntry = &ActorEntry;
 			ActorPools.MarkItemDirty(ActorEntry);
@@ -122,15 +325,15 @@ AActor* AReplicateProxyActor::SpawnActor(const FPoolActorSpawnParameters& SpawnP
 
 	if (!Found)
 	{
-		FOtterPoolActorEntry& Entry = ActorPools.Items.AddDefaulted_GetRef();
-		Entry.UsingBit = 0;
-		Entry.CacheClientUsingBit = 0;
-		Entry.ActorClass = SpawnParameter.ActorClass;
-		Entry.bStartWithTickEnable = SpawnParameter.ActorClass.GetDefaultObject()->PrimaryActorTick.bStartWithTickEnabled;
+		if (HasReachedMaxCount(SpawnParameter.ActorClass))
+			return SpawnOverCapActor(SpawnParameter, StartTime);
+		FOtterPoolActorEntry& Entry = AddEntry(SpawnParameter.ActorClass);
 		Found = Entry.SpawnActor(GetWorld(), SpawnParameter, true);
 		if (!Found)
 			return nullptr;
 		ActorPools.MarkItemDirty(Entry);
+		RecordAcquire(Entry, Found, true, FPlatformTime::Seconds() - StartTime);
+		return Found->Actor;
 	}
 	else
 	{
@@ -141,7 +344,8 @@ AActor* AReplicateProxyActor::SpawnActor(const FPoolActorSpawnParameters& SpawnP
 
 		if (FoundEntry)
 		{
-			Actor->SetActorTickEnabled(FoundEntry->bStartWithTickEnable);
+			if (!FoundEntry->bBatchedTick)
+				Actor->SetActorTickEnabled(FoundEntry->bStartWithTickEnable);
 			Found->SpawnLocation = SpawnParameter.Transform.GetLocation();
 			Found->SpawnRotation = SpawnParameter.Transform.GetRotation();
 			Found->SpawnScale = SpawnParameter.Transform.GetScale3D();
@@ -155,13 +359,142 @@ AActor* AReplicateProxyActor::SpawnActor(const FPoolActorSpawnParameters& SpawnP
 		Actor->DispatchBeginPlay();
 		if (FoundEntry)
 		{
+			// Components batched by the class have bStartWithTickEnabled cleared and stay off
 			FoundEntry->SetComponentTick(Actor, true);
 		}
 		Actor->ForceNetUpdate();
 	}
+	if (FoundEntry)
+		RecordAcquire(*FoundEntry, Found, false, FPlatformTime::Seconds() - StartTime);
 	return Found->Actor;
 }
 
+FOtterPoolActorEntry& AReplicateProxyActor::AddEntry(TSubclassOf<AActor> ActorClass)
+{
+	FOtterPoolActorEntry& Entry = ActorPools.Items.AddDefaulted_GetRef();
+	Entry.UsingBit = 0;
+	Entry.CacheClientUsingBit = 0;
+	Entry.ActorClass = ActorClass;
+	Entry.bStartWithTickEnable = ActorClass.GetDefaultObject()->PrimaryActorTick.bStartWithTickEnabled;
+	Entry.InitBatchedTick();
+	if (Entry.bBatchedTick)
+		RegisterBatchedTick(Entry.ActorClass);
+	return Entry;
+}
+
+int32 AReplicateProxyActor::GetNumCachedActor(TSubclassOf<AActor> ActorClass) const
+{
+	int32 NumCached = 0;
+	for (auto& ActorEntry : ActorPools.Items)
+	{
+		if (ActorEntry.ActorClass == ActorClass)
+			NumCached += ActorEntry.CacheActors.Num();
+	}
+	return NumCached;
+}
+
+int32 AReplicateProxyActor::GetNumInUse(TSubclassOf<AActor> ActorClass) const
+{
+	int32 NumInUse = 0;
+	for (auto& ActorEntry : ActorPools.Items)
+	{
+		if (ActorEntry.ActorClass == ActorClass)
+			NumInUse += FMath::CountBits(ActorEntry.UsingBit);
+	}
+	return NumInUse;
+}
+
+bool AReplicateProxyActor::HasReachedMaxCount(TSubclassOf<AActor> ActorClass) const
+{
+	auto MaxCount = ClassMaxCount.Find(ActorClass.Get());
+	return MaxCount && *MaxCount > 0 && GetNumCachedActor(ActorClass) >= *MaxCount;
+}
+
+AActor* AReplicateProxyActor::SpawnOverCapActor(const FPoolActorSpawnParameters& SpawnParameter, double StartTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AReplicateProxyActor::SpawnOverCapActor);
+	// Not added to any entry, ReleaseToPool destroy it like any non pooled actor,
+	// TickBatched call OnPoolTick on it through ClassUsage.OverCapActors
+	const bool bBatchedTick = FOtterPoolActorEntry::UseBatchedTick(SpawnParameter.ActorClass);
+	auto Actor = FOtterPoolActorEntry::SpawnPoolActor(GetWorld(), SpawnParameter, bBatchedTick);
+	if (!Actor)
+		return nullptr;
+	if (bBatchedTick)
+		RegisterBatchedTick(SpawnParameter.ActorClass);
+
+	auto& Usage = ClassUsage.FindOrAdd(SpawnParameter.ActorClass.Get());
+	if (Usage.NumOverCap == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Pool: Reach cap %d actor for class %s, spawn without pool"), ClassMaxCount.FindRef(SpawnParameter.ActorClass.Get()), *GetNameSafe(SpawnParameter.ActorClass));
+	}
+	Usage.NumOverCap++;
+	Usage.OverCapActors.Add(Actor);
+	RecordUsage(SpawnParameter.ActorClass, true, FPlatformTime::Seconds() - StartTime);
+	return Actor;
+}
+
+void AReplicateProxyActor::RecordAcquire(const FOtterPoolActorEntry& AcquireEntry, const FOtterActorPoolData* ActorData, bool bMiss, double SpawnSeconds)
+{
+#if OTTER_POOL_NET_STATS
+	FOtterPoolNetStats::Get().RecordServerAcquire(AcquireEntry.ActorClass, AcquireEntry.ReplicationID, ActorData - AcquireEntry.CacheActors.GetData(), bMiss);
+#endif
+	RecordUsage(AcquireEntry.ActorClass, bMiss, SpawnSeconds);
+}
+
+void AReplicateProxyActor::RecordUsage(TSubclassOf<AActor> ActorClass, bool bMiss, double SpawnSeconds)
+{
+	auto& Usage = ClassUsage.FindOrAdd(ActorClass.Get());
+	// Over cap actors are demand the pool could not serve, count them in the peak
+	if (Usage.OverCapActors.Num() > 0)
+		Usage.OverCapActors.RemoveAllSwap([](const TWeakObjectPtr<AActor>& Actor) { return !Actor.IsValid(); });
+	Usage.PeakInUse = FMath::Max(Usage.PeakInUse, GetNumInUse(ActorClass) + Usage.OverCapActors.Num());
+	Usage.NumAcquire++;
+	if (bMiss)
+	{
+		Usage.NumMiss++;
+		Usage.SpawnSeconds += SpawnSeconds;
+	}
+}
+
+void AReplicateProxyActor::ApplySizing(TSubclassOf<AActor> ActorClass, int32 WarmCount, int32 MaxCount)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AReplicateProxyActor::ApplySizing);
+	if (!ActorClass || !HasAuthority())
+		return;
+	// Before begin play FinishSpawning skip BeginPlay and the world dispatch it later to the idle actors
+	if (!GetWorld()->HasBegunPlay())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Pool: sizing of class %s ignored, world has not begun play"), *GetNameSafe(ActorClass));
+		return;
+	}
+	if (MaxCount > 0)
+	{
+		ClassMaxCount.Add(ActorClass.Get(), MaxCount);
+		WarmCount = FMath::Min(WarmCount, MaxCount);
+	}
+
+	FPoolActorSpawnParameters Parameters;
+	Parameters.ActorClass = ActorClass;
+	Parameters.bDisableCollisionOnSpawn = true;
+	int32 NumCached = GetNumCachedActor(ActorClass);
+	while (NumCached < WarmCount)
+	{
+		FOtterPoolActorEntry* Entry = ActorPools.Items.FindByPredicate([ActorClass](const FOtterPoolActorEntry& ActorEntry)
+			{
+				return ActorEntry.ActorClass == ActorClass && !ActorEntry.IsFull();
+			});
+		if (!Entry)
+			Entry = &AddEntry(ActorClass);
+		auto ActorData = Entry->SpawnActor(GetWorld(), Parameters, false);
+		if (!ActorData)
+			break;
+		Entry->OnActorEndPlay(ActorData->Actor);
+		ActorData->Actor->SetNetDormancy(ENetDormancy::DORM_DormantAll);
+		ActorPools.MarkItemDirty(*Entry);
+		NumCached++;
+	}
+}
+
 AActor * AReplicateProxyActor::SpawnActor(TSubclassOf<AActor> ActorClass, FTransform const & Transform, AActor * OwnerActor, APawn * InstigatorActor)
 {
 	FPoolActorSpawnParameters Parameters;
@@ -184,12 +517,344 @@ bool AReplicateProxyActor::ReleaseToPool(AActor* Actor)
 		if (!ActorEntry.PushToPool(Actor))
 			continue;
 		ActorPools.MarkItemDirty(ActorEntry);
+#if OTTER_POOL_NET_STATS
+		FOtterPoolNetStats::Get().RecordServerRelease(ActorEntry.ActorClass);
+#endif
 		return true;
 	}
 	Actor->Destroy();
 	return true;
 }
 
+int32 AReplicateProxyActor::AddStandIn(TSubclassOf<AActor> ActorClass, FTransform const& Transform)
+{
+	if (!ActorClass || !HasAuthority())
+		return INDEX_NONE;
+	auto PoolInterface = Cast<IOtterPoolActorInterface>(ActorClass.GetDefaultObject());
+	if (!PoolInterface || !PoolInterface->GetPoolStandInMesh())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Pool: class %s does not provide a stand-in mesh"), *GetNameSafe(ActorClass));
+		return INDEX_NONE;
+	}
+
+	if (FreeStandInItems.IsEmpty() && StandIns.Items.Num() >= GetMaxStandInItems())
+	{
+		if (!bWarnedStandInCap)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Pool: Reach cap %d stand-in (net.MaxNumberOfAllowedTArrayChangesPerUpdate), late joiner could not receive more, class %s not added"), StandIns.Items.Num(), *GetNameSafe(ActorClass));
+			bWarnedStandInCap = true;
+		}
+		return INDEX_NONE;
+	}
+
+	// Reuse freed items so add/remove only dirty one item instead of the whole array
+	const int32 ItemIndex = FreeStandInItems.Num() > 0 ? FreeStandInItems.Pop() : StandIns.Items.AddDefaulted();
+	auto& Item = StandIns.Items[ItemIndex];
+	Item.Handle = NextStandInHandle++;
+	Item.ActorClass = ActorClass;
+	Item.SetTransform(Transform);
+	StandIns.MarkItemDirty(Item);
+	StandInItemIndices.Add(Item.Handle, ItemIndex);
+	AddStandInToCell(ItemIndex);
+	AddStandInInstance(Item.ActorClass, Item.Handle, Item.GetTransform());
+	return Item.Handle;
+}
+
+AActor* AReplicateProxyActor::PromoteStandIn(int32 Handle, AActor* OwnerActor, APawn* InstigatorActor)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AReplicateProxyActor::PromoteStandIn);
+	auto ItemIndex = StandInItemIndices.Find(Handle);
+	if (!HasAuthority() || !ItemIndex)
+		return nullptr;
+
+	const int32 Index = *ItemIndex;
+	auto Actor = SpawnActor(StandIns.Items[Index].ActorClass, StandIns.Items[Index].GetTransform(), OwnerActor, InstigatorActor);
+	if (!Actor)
+		return nullptr;
+	FreeStandIn(Index);
+	return Actor;
+}
+
+int32 AReplicateProxyActor::DemoteToStandIn(AActor* Actor)
+{
+	if (!IsValid(Actor) || !HasAuthority())
+		return INDEX_NONE;
+	auto PoolInterface = Cast<IOtterPoolActorInterface>(Actor->GetClass()->GetDefaultObject());
+	if (!PoolInterface || !PoolInterface->GetPoolStandInMesh())
+		return INDEX_NONE;
+
+	TSubclassOf<AActor> ActorClass = Actor->GetClass();
+	const FTransform Transform = Actor->GetActorTransform();
+	if (!ReleaseToPool(Actor))
+		return INDEX_NONE;
+	return AddStandIn(ActorClass, Transform);
+}
+
+bool AReplicateProxyActor::RemoveStandIn(int32 Handle)
+{
+	auto ItemIndex = StandInItemIndices.Find(Handle);
+	if (!HasAuthority() || !ItemIndex)
+		return false;
+	FreeStandIn(*ItemIndex);
+	return true;
+}
+
+void AReplicateProxyActor::FreeStandIn(int32 ItemIndex)
+{
+	auto& Item = StandIns.Items[ItemIndex];
+	RemoveStandInInstance(Item.ActorClass, Item.Handle);
+	RemoveStandInFromCell(ItemIndex);
+	StandInItemIndices.Remove(Item.Handle);
+	Item.Handle = INDEX_NONE;
+	Item.ActorClass = nullptr;
+	StandIns.MarkItemDirty(Item);
+	FreeStandInItems.Add(ItemIndex);
+}
+
+void AReplicateProxyActor::AddStandInToCell(int32 ItemIndex)
+{
+	const auto& Item = StandIns.Items[ItemIndex];
+	StandInCells.FindOrAdd(Item.ActorClass.Get()).FindOrAdd(GetStandInCell(Item.Location)).Add(ItemIndex);
+}
+
+void AReplicateProxyActor::RemoveStandInFromCell(int32 ItemIndex)
+{
+	const auto& Item = StandIns.Items[ItemIndex];
+	auto ClassCells = StandInCells.Find(Item.ActorClass.Get());
+	if (!ClassCells)
+		return;
+	const FIntVector CellKey = GetStandInCell(Item.Location);
+	if (auto Cell = ClassCells->Find(CellKey))
+	{
+		Cell->RemoveSingleSwap(ItemIndex);
+		if (Cell->IsEmpty())
+			ClassCells->Remove(CellKey);
+	}
+}
+
+int32 AReplicateProxyActor::FindStandIns(TSubclassOf<AActor> ActorClass, const FVector& Location, float Radius, TArray<int32>& OutHandles) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AReplicateProxyActor::FindStandIns);
+	if (!HasAuthority() || Radius < 0.0f)
+		return 0;
+
+	const FIntVector MinCell = GetStandInCell(Location - FVector(Radius));
+	const FIntVector MaxCell = GetStandInCell(Location + FVector(Radius));
+	const int64 NumCellInRange = int64(MaxCell.X - MinCell.X + 1) * (MaxCell.Y - MinCell.Y + 1) * (MaxCell.Z - MinCell.Z + 1);
+	const double RadiusSquared = FMath::Square(Radius);
+	TArray<TPair<double, int32>, TInlineAllocator<32>> Found;
+	auto GatherCell = [&](const TArray<int32>& ItemIndices)
+		{
+			for (int32 ItemIndex : ItemIndices)
+			{
+				const auto& Item = StandIns.Items[ItemIndex];
+				const double DistSquared = FVector::DistSquared(Item.Location, Location);
+				if (DistSquared <= RadiusSquared)
+					Found.Emplace(DistSquared, Item.Handle);
+			}
+		};
+
+	for (auto& ClassCells : StandInCells)
+	{
+		if (ActorClass && ClassCells.Key != ActorClass.Get())
+			continue;
+		// Radius covering more cells than the class occupy, walk the occupied cells instead
+		if (NumCellInRange > ClassCells.Value.Num())
+		{
+			for (auto& Cell : ClassCells.Value)
+			{
+				if (Cell.Key.X >= MinCell.X && Cell.Key.X <= MaxCell.X
+					&& Cell.Key.Y >= MinCell.Y && Cell.Key.Y <= MaxCell.Y
+					&& Cell.Key.Z >= MinCell.Z && Cell.Key.Z <= MaxCell.Z)
+					GatherCell(Cell.Value);
+			}
+			continue;
+		}
+		for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+			{
+				for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++)
+				{
+					if (auto Cell = ClassCells.Value.Find(FIntVector(X, Y, Z)))
+						GatherCell(*Cell);
+				}
+			}
+		}
+	}
+	// Closest first
+	Found.Sort([](const TPair<double, int32>& A, const TPair<double, int32>& B) { return A.Key < B.Key; });
+	for (auto& Pair : Found)
+		OutHandles.Add(Pair.Value);
+	return Found.Num();
+}
+
+int32 AReplicateProxyActor::GetStandInHandle(const UPrimitiveComponent* Component, int32 InstanceIndex) const
+{
+	for (auto& Batch : StandInBatches)
+	{
+		if (Batch.Value.Component == Component)
+			return Batch.Value.Handles.IsValidIndex(InstanceIndex) ? Batch.Value.Handles[InstanceIndex] : INDEX_NONE;
+	}
+	return INDEX_NONE;
+}
+
+void AReplicateProxyActor::AddStandInInstance(UClass* ActorClass, int32 Handle, const FTransform& Transform)
+{
+	if (GetNetMode() == NM_DedicatedServer || !ActorClass)
+		return;
+
+	auto& Batch = StandInBatches.FindOrAdd(ActorClass);
+	if (!IsValid(Batch.Component))
+	{
+		auto PoolInterface = Cast<IOtterPoolActorInterface>(ActorClass->GetDefaultObject());
+		auto Mesh = PoolInterface ? PoolInterface->GetPoolStandInMesh() : nullptr;
+		if (!Mesh)
+			return;
+		Batch.Component = NewObject<UInstancedStaticMeshComponent>(this, NAME_None, RF_Transient);
+		Batch.Component->SetStaticMesh(Mesh);
+		// No physics body per instance unless the class opt in for interaction traces, see GetStandInHandle
+		const FName CollisionProfile = PoolInterface->GetPoolStandInCollisionProfile();
+		if (CollisionProfile.IsNone())
+			Batch.Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		else
+			Batch.Component->SetCollisionProfileName(CollisionProfile);
+		Batch.Component->SetCanEverAffectNavigation(false);
+		Batch.Component->RegisterComponent();
+		Batch.Handles.Reset();
+	}
+	StandInInstanceIndices.Add(Handle, Batch.Component->AddInstance(Transform, true));
+	Batch.Handles.Add(Handle);
+}
+
+void AReplicateProxyActor::RemoveStandInInstance(UClass* ActorClass, int32 Handle)
+{
+	auto Batch = StandInBatches.Find(ActorClass);
+	int32 InstanceIndex = INDEX_NONE;
+	if (!Batch || !IsValid(Batch->Component) || !StandInInstanceIndices.RemoveAndCopyValue(Handle, InstanceIndex))
+		return;
+
+	// Move the last instance into the hole so only one handle change index
+	const int32 LastIndex = Batch->Handles.Num() - 1;
+	if (InstanceIndex != LastIndex)
+	{
+		FTransform LastTransform;
+		Batch->Component->GetInstanceTransform(LastIndex, LastTransform, true);
+		Batch->Component->UpdateInstanceTransform(InstanceIndex, LastTransform, true, true);
+		Batch->Handles[InstanceIndex] = Batch->Handles[LastIndex];
+		StandInInstanceIndices.Add(Batch->Handles[InstanceIndex], InstanceIndex);
+	}
+	Batch->Component->RemoveInstance(LastIndex);
+	Batch->Handles.Pop();
+}
+
+FTransform FOtterPoolStandInItem::GetTransform() const
+{
+	return FTransform(Rotation, Location, Scale);
+}
+
+void FOtterPoolStandInItem::SetTransform(const FTransform& Transform)
+{
+	Location = Transform.GetLocation();
+	Rotation = Transform.Rotator();
+	Scale = Transform.GetScale3D();
+}
+
+void FOtterPoolStandInItem::PreReplicatedRemove(const struct FOtterPoolStandInArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner.IsValid() && ClientHandle != INDEX_NONE)
+		InArraySerializer.Owner->RemoveStandInInstance(ClientActorClass, ClientHandle);
+	ClientHandle = INDEX_NONE;
+}
+
+void FOtterPoolStandInItem::PostReplicatedAdd(const struct FOtterPoolStandInArray& InArraySerializer)
+{
+	PostReplicatedChange(InArraySerializer);
+}
+
+void FOtterPoolStandInItem::PostReplicatedChange(const struct FOtterPoolStandInArray& InArraySerializer)
+{
+	// Items are recycled by the server, drop what this item showed before and show the current stand-in
+	PreReplicatedRemove(InArraySerializer);
+	if (!IsActive() || !InArraySerializer.Owner.IsValid())
+		return;
+	InArraySerializer.Owner->AddStandInInstance(ActorClass, Handle, GetTransform());
+	ClientHandle = Handle;
+	ClientActorClass = ActorClass;
+}
+
+void AReplicateProxyActor::RegisterBatchedTick(TSubclassOf<AActor> ActorClass)
+{
+	for (auto& TickFunction : BatchedTickFunctions)
+	{
+		if (TickFunction->ActorClass == ActorClass)
+			return;
+	}
+
+	auto& TickFunction = BatchedTickFunctions.Add_GetRef(MakeUnique<FOtterPoolBatchTickFunction>());
+	TickFunction->ActorClass = ActorClass;
+	TickFunction->Owner = this;
+	TickFunction->TickGroup = ActorClass.GetDefaultObject()->PrimaryActorTick.TickGroup;
+	TickFunction->bCanEverTick = true;
+	TickFunction->bStartWithTickEnabled = true;
+	TickFunction->RegisterTickFunction(GetLevel());
+}
+
+void AReplicateProxyActor::TickBatched(TSubclassOf<AActor> ActorClass, float DeltaTime)
+{
+	// OnPoolTick may acquire or release from the pool and reallocate Items,
+	// so work by index and fetch the entry again after every callback
+	for (int32 EntryIndex = 0; EntryIndex < ActorPools.Items.Num(); EntryIndex++)
+	{
+		if (!ActorPools.Items[EntryIndex].bBatchedTick || ActorPools.Items[EntryIndex].ActorClass != ActorClass)
+			continue;
+
+		// Walk set bits from low to high so actors are visited in CacheActors order
+		uint64 ActiveBit = ActorPools.Items[EntryIndex].UsingBit;
+		while (ActiveBit && ActorPools.Items.IsValidIndex(EntryIndex))
+		{
+			const int32 Index = FMath::CountTrailingZeros64(ActiveBit);
+			ActiveBit &= ActiveBit - 1;
+			const auto& ActorEntry = ActorPools.Items[EntryIndex];
+			if (!ActorEntry.CacheActors.IsValidIndex(Index))
+				break;
+			// Released by an earlier callback of this tick
+			if (!(ActorEntry.UsingBit & (uint64(1) << Index)))
+				continue;
+			auto CacheActor = ActorEntry.CacheActors[Index].Actor;
+			if (!IsValid(CacheActor))
+				continue;
+			if (auto PoolInterface = Cast<IOtterPoolActorInterface>(CacheActor))
+				PoolInterface->OnPoolTick(CacheActor, DeltaTime);
+		}
+	}
+
+	// Over cap actors are not in any entry, same index walk as the callback can spawn more of them
+	for (int32 Index = 0; ; Index++)
+	{
+		auto Usage = ClassUsage.Find(ActorClass.Get());
+		if (!Usage || !Usage->OverCapActors.IsValidIndex(Index))
+			break;
+		auto OverCapActor = Usage->OverCapActors[Index].Get();
+		if (!IsValid(OverCapActor))
+			continue;
+		if (auto PoolInterface = Cast<IOtterPoolActorInterface>(OverCapActor))
+			PoolInterface->OnPoolTick(OverCapActor, DeltaTime);
+	}
+}
+
+void FOtterPoolBatchTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FOtterPoolBatchTickFunction::ExecuteTick);
+	if (auto ProxyActor = Owner.Get())
+		ProxyActor->TickBatched(ActorClass, DeltaTime);
+}
+
+FString FOtterPoolBatchTickFunction::DiagnosticMessage()
+{
+	return FString::Printf(TEXT("OtterPoolBatchTick[%s]"), *GetNameSafe(ActorClass));
+}
+
 bool FOtterPoolActorEntry::IsFull() const
 {
 	return CacheActors.Num() >= MAX_ELEMENT;
@@ -230,6 +895,20 @@ FOtterActorPoolData* FOtterPoolActorEntry::SpawnActor(UWorld* InWorld, const FPo
 		return nullptr;
 	}
 
+	auto Found = SpawnPoolActor(InWorld, SpawnParameter, bBatchedTick);
+	if (!Found)
+		return nullptr;
+	auto& ActorData = CacheActors.AddDefaulted_GetRef();
+	ActorData.Actor = Found;
+	if (bUsedNow)
+	{
+		SetSlot(CacheActors.Num() - 1, true);
+	}
+	return &ActorData;
+}
+
+AActor* FOtterPoolActorEntry::SpawnPoolActor(UWorld* InWorld, const FPoolActorSpawnParameters& SpawnParameter, bool bBatchedTick)
+{
 	TRACE_CPUPROFILER_EVENT_SCOPE(OtterSkill::SpawnNewActorInPool);
 	FActorSpawnParameters SpawnParameters;
 	SpawnParameters.Owner = SpawnParameter.Owner;
@@ -244,19 +923,15 @@ FOtterActorPoolData* FOtterPoolActorEntry::SpawnActor(UWorld* InWorld, const FPo
 		Found->SetActorEnableCollision(false);
 	SpawnParameter.PreBeginPlayDelegate.ExecuteIfBound(Found);
 	Found->FinishSpawning(SpawnParameter.Transform);
+	if (bBatchedTick)
+		DisableBatchedActorTick(Found);
 	if (auto PoolInterface = Cast<IOtterPoolActorInterface>(Found))
 	{
 		PoolInterface->SetEnable(true);
 		if (PoolInterface->ShouldCollectProperty())
 			PoolInterface->CollectProperty(Found, SpawnParameter.RootActorClass);
 	}
-	auto& ActorData = CacheActors.AddDefaulted_GetRef();
-	ActorData.Actor = Found;
-	if (bUsedNow)
-	{
-		SetSlot(CacheActors.Num() - 1, true);
-	}
-	return &ActorData;
+	return Found;
 }
 
 void FOtterPoolActorEntry::SetSlot(int Index, bool bUsed)
@@ -287,7 +962,8 @@ void FOtterPoolActorEntry::OnActorEndPlay(AActor* InActor)
 	InActor->RouteEndPlay(EEndPlayReason::Destroyed);
 	InActor->SetActorEnableCollision(false);
 	InActor->SetActorHiddenInGame(true);
-	InActor->SetActorTickEnabled(false);
+	if (!bBatchedTick)
+		InActor->SetActorTickEnabled(false);
 	SetComponentTick(InActor, false);
 #if !UE_BUILD_SHIPPING
 	InActor->MarkComponentsRenderStateDirty();
@@ -320,8 +996,57 @@ void FOtterPoolActorEntry::SetComponentTick(AActor* InActor, bool bEnable)
 	}
 }
 
+bool FOtterPoolActorEntry::UseBatchedTick(TSubclassOf<AActor> ActorClass)
+{
+	auto PoolInterface = ActorClass ? Cast<IOtterPoolActorInterface>(ActorClass.GetDefaultObject()) : nullptr;
+	return PoolInterface && PoolInterface->UsePoolBatchedTick();
+}
+
+void FOtterPoolActorEntry::InitBatchedTick()
+{
+	bBatchedTick = UseBatchedTick(ActorClass);
+}
+
+void FOtterPoolActorEntry::DisableBatchedActorTick(AActor* InActor)
+{
+	// Clear start flags on the instance too: DispatchBeginPlay on every acquire register tick functions
+	// again with bStartWithTickEnabled || IsTickFunctionEnabled(), both false keep the tick off
+	InActor->PrimaryActorTick.bStartWithTickEnabled = false;
+	InActor->SetActorTickEnabled(false);
+
+	// Only components the class hand over to OnPoolTick, the others follow the normal acquire/release tick
+	auto PoolInterface = Cast<IOtterPoolActorInterface>(InActor);
+	if (!PoolInterface)
+		return;
+	TInlineComponentArray<UActorComponent*> Components;
+	InActor->GetComponents(Components);
+	for (auto Component : Components)
+	{
+		if (!PoolInterface->ShouldPoolBatchComponentTick(Component))
+			continue;
+		Component->PrimaryComponentTick.bStartWithTickEnabled = false;
+		Component->SetComponentTickEnabled(false);
+	}
+}
+
+void FOtterPoolActorEntry::DisableResolvedBatchedTick()
+{
+	if (!bBatchedTick)
+		return;
+	// Actor reference can resolve after the entry is added (actor channel not open yet) or be appended later
+	for (auto Index = 0; Index < CacheActors.Num() && Index < MAX_ELEMENT; Index++)
+	{
+		const uint64 SlotBit = uint64(1) << Index;
+		if ((ClientTickDisabledBit & SlotBit) || !IsValid(CacheActors[Index].Actor))
+			continue;
+		DisableBatchedActorTick(CacheActors[Index].Actor);
+		ClientTickDisabledBit |= SlotBit;
+	}
+}
+
 void FOtterPoolActorEntry::PostReplicatedChange(const struct FOtterPoolActorArray& InArraySerializer)
 {
+	DisableResolvedBatchedTick();
 	if (UsingBit != CacheClientUsingBit)
 	{
 		std::bitset<MAX_ELEMENT> newbitset(UsingBit);
@@ -339,7 +1064,8 @@ void FOtterPoolActorEntry::PostReplicatedChange(const struct FOtterPoolActorArra
 			if (newbitset.test(Index))
 			{
 				CacheActor->SetActorTransform(FTransform(CacheActors[Index].SpawnRotation, CacheActors[Index].SpawnLocation, CacheActors[Index].SpawnScale));
-				CacheActor->SetActorTickEnabled(bStartWithTickEnable);
+				if (!bBatchedTick)
+					CacheActor->SetActorTickEnabled(bStartWithTickEnable);
 				CacheActor->SetActorEnableCollision(true);
 #if !UE_BUILD_SHIPPING
 				CacheActor->MarkComponentsRenderStateDirty();
@@ -348,12 +1074,23 @@ void FOtterPoolActorEntry::PostReplicatedChange(const struct FOtterPoolActorArra
 				CacheActor->InitializeComponents();
 				CacheActor->DispatchBeginPlay();
 				SetComponentTick(CacheActor, true);
+#if OTTER_POOL_NET_STATS
+				FOtterPoolNetStats::Get().RecordClientActivation(ReplicationID, Index, false);
+#endif
 			}
 			else
 			{
 				OnActorEndPlay(CacheActor);
 			}
 		}
+#if OTTER_POOL_NET_STATS
+		// Slots appended by a server pool miss are not activated above, the actor come with its own channel
+		for (int32 Index = NumActor; Index < CacheActors.Num() && Index < MAX_ELEMENT; Index++)
+		{
+			if (newbitset.test(Index))
+				FOtterPoolNetStats::Get().RecordClientActivation(ReplicationID, Index, true);
+		}
+#endif
 		NumActor = CacheActors.Num();
 		CacheClientUsingBit = UsingBit;
 	}
@@ -366,8 +1103,19 @@ void FOtterPoolActorEntry::PostReplicatedAdd(const struct FOtterPoolActorArray&
 	{
 		bStartWithTickEnable = ActorClass.GetDefaultObject()->PrimaryActorTick.bStartWithTickEnabled;
 	}
+	InitBatchedTick();
+	if (bBatchedTick && InArraySerializer.Owner.IsValid())
+		InArraySerializer.Owner->RegisterBatchedTick(ActorClass);
 	CacheClientUsingBit = UsingBit;
 	NumActor = CacheActors.Num();
+	DisableResolvedBatchedTick();
+#if OTTER_POOL_NET_STATS
+	for (int32 Index = 0; Index < NumActor && Index < MAX_ELEMENT; Index++)
+	{
+		if (UsingBit & (uint64(1) << Index))
+			FOtterPoolNetStats::Get().RecordClientActivation(ReplicationID, Index, true);
+	}
+#endif
 	for (auto& ActorData : CacheActors)
 	{
 		auto PoolInterface = Cast<IOtterPoolActorInterface>(ActorData.Actor);
@@ -380,5 +1128,35 @@ void FOtterPoolActorArray::PostReplicatedAdd(const TArrayView<int32> AddedIndice
 {
 }
 
+bool FOtterPoolActorArray::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+#if OTTER_POOL_NET_STATS
+	if (DeltaParms.Writer && FOtterPoolNetStats::Get().bEnabled)
+	{
+		const int64 StartBits = DeltaParms.Writer->GetNumBits();
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		const bool bResult = FFastArraySerializer::FastArrayDeltaSerialize<FOtterPoolActorEntry, FOtterPoolActorArray>(Items, DeltaParms, *this);
+		FOtterPoolNetStats::Get().RecordServerSerialize(DeltaParms.Writer->GetNumBits() - StartBits, FPlatformTime::Cycles64() - StartCycles, false);
+		return bResult;
+	}
+#endif
+	return FFastArraySerializer::FastArrayDeltaSerialize<FOtterPoolActorEntry, FOtterPoolActorArray>(Items, DeltaParms, *this);
+}
+
+bool FOtterPoolStandInArray::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+#if OTTER_POOL_NET_STATS
+	if (DeltaParms.Writer && FOtterPoolNetStats::Get().bEnabled)
+	{
+		const int64 StartBits = DeltaParms.Writer->GetNumBits();
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		const bool bResult = FFastArraySerializer::FastArrayDeltaSerialize<FOtterPoolStandInItem, FOtterPoolStandInArray>(Items, DeltaParms, *this);
+		FOtterPoolNetStats::Get().RecordServerSerialize(DeltaParms.Writer->GetNumBits() - StartBits, FPlatformTime::Cycles64() - StartCycles, true);
+		return bResult;
+	}
+#endif
+	return FFastArraySerializer::FastArrayDeltaSerialize<FOtterPoolStandInItem, FOtterPoolStandInArray>(Items, DeltaParms, *this);
+}
+
 
 
@@ -1,6 +1,7 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "OtterNetworkPoolActor.h"
+#include "OtterPoolSoakBenchmark.h"
 
 #define LOCTEXT_NAMESPACE "FOtterNetworkPoolActorModule"
 
@@ -13,6 +14,9 @@ void FOtterNetworkPoolActorModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+#if OTTER_POOL_NET_STATS
+	FOtterPoolSoakBenchmark::Shutdown();
+#endif
 }
 
 #undef LOCTEXT_NAMESPACE
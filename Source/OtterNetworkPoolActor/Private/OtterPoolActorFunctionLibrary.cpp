@@ -29,3 +29,57 @@ bool UOtterPoolActorFunctionLibrary::DestroyActorFromPool(AActor* ActorToDestroy
 	}
 	return false;
 }
+
+int32 UOtterPoolActorFunctionLibrary::AddStandInToPool(UObject* WorldContextObject, TSubclassOf<AActor> ActorClass, const FTransform& SpawnTransform)
+{
+	if (auto System = Get(WorldContextObject))
+	{
+		return System->AddStandIn(ActorClass, SpawnTransform);
+	}
+	return INDEX_NONE;
+}
+
+AActor* UOtterPoolActorFunctionLibrary::PromoteStandInFromPool(UObject* WorldContextObject, int32 StandInHandle, AActor* OwnerActor, APawn* Instigator)
+{
+	if (auto System = Get(WorldContextObject))
+	{
+		return System->PromoteStandIn(StandInHandle, OwnerActor, Instigator);
+	}
+	return nullptr;
+}
+
+int32 UOtterPoolActorFunctionLibrary::DemoteActorToStandIn(AActor* ActorToDemote)
+{
+	if (auto System = Get(ActorToDemote))
+	{
+		return System->DemoteToStandIn(ActorToDemote);
+	}
+	return INDEX_NONE;
+}
+
+bool UOtterPoolActorFunctionLibrary::RemoveStandInFromPool(UObject* WorldContextObject, int32 StandInHandle)
+{
+	if (auto System = Get(WorldContextObject))
+	{
+		return System->RemoveStandIn(StandInHandle);
+	}
+	return false;
+}
+
+int32 UOtterPoolActorFunctionLibrary::FindStandInsInPool(UObject* WorldContextObject, TSubclassOf<AActor> ActorClass, FVector Location, float Radius, TArray<int32>& OutStandInHandles)
+{
+	if (auto System = Get(WorldContextObject))
+	{
+		return System->FindStandIns(ActorClass, Location, Radius, OutStandInHandles);
+	}
+	return 0;
+}
+
+int32 UOtterPoolActorFunctionLibrary::GetStandInHandleFromHit(UObject* WorldContextObject, const FHitResult& Hit)
+{
+	if (auto System = Get(WorldContextObject))
+	{
+		return System->GetStandInHandle(Hit.GetComponent(), Hit.Item);
+	}
+	return INDEX_NONE;
+}
@@ -0,0 +1,396 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "OtterPoolSoakBenchmark.h"
+
+#if OTTER_POOL_NET_STATS
+
+#include "OtterActorPoolWorldSubsystem.h"
+#include "OtterPoolActorFunctionLibrary.h"
+#include "Engine/Engine.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+static FAutoConsoleCommand SoakStartCommand(
+	TEXT("Otter.Pool.Soak"),
+	TEXT("Run pool soak benchmark on the server world: Class=<ClassPath> [Population=32] [OpsPerSecond=60] [Seconds=30] [PktLag=100] [PktLoss=2] [Quit=0]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			FOtterPoolSoakBenchmark::FSettings Settings;
+			if (!FOtterPoolSoakBenchmark::ParseSettings(FString::Join(Args, TEXT(" ")), Settings))
+				return;
+			if (FOtterPoolSoakBenchmark::GetNumClientWorld() == 0)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Pool soak: no client world in this process, latency and desync will not be measured"));
+			}
+			FOtterPoolSoakBenchmark::Start(Settings);
+		}));
+
+static FAutoConsoleCommand SoakStopCommand(
+	TEXT("Otter.Pool.SoakStop"),
+	TEXT("Stop the running pool soak benchmark and report"),
+	FConsoleCommandDelegate::CreateStatic(&FOtterPoolSoakBenchmark::Stop));
+
+FOtterPoolSoakBenchmark* FOtterPoolSoakBenchmark::ActiveBenchmark = nullptr;
+TArray<TPair<FString, FString>> FOtterPoolSoakBenchmark::LastReport;
+
+FOtterPoolNetStats& FOtterPoolNetStats::Get()
+{
+	static FOtterPoolNetStats Instance;
+	return Instance;
+}
+
+void FOtterPoolNetStats::Reset()
+{
+	*this = FOtterPoolNetStats();
+}
+
+void FOtterPoolNetStats::RecordServerAcquire(UClass* InActorClass, int32 ReplicationID, int32 Slot, bool bNewSlot)
+{
+	if (!bEnabled || (ActorClass && InActorClass != ActorClass))
+		return;
+	NumAcquire++;
+	if (bNewSlot)
+		NumNewSlotAcquire++;
+	PendingAcquireTime.Add(MakeSlotKey(ReplicationID, Slot), FPlatformTime::Seconds());
+}
+
+void FOtterPoolNetStats::RecordServerRelease(UClass* InActorClass)
+{
+	if (!bEnabled || (ActorClass && InActorClass != ActorClass))
+		return;
+	NumRelease++;
+}
+
+void FOtterPoolNetStats::RecordServerSerialize(int64 NumBits, uint64 Cycles, bool bStandIn)
+{
+	if (!bEnabled)
+		return;
+	NumSerialize++;
+	(bStandIn ? StandInArrayBits : PoolArrayBits) += NumBits;
+	SerializeCycles += Cycles;
+}
+
+void FOtterPoolNetStats::RecordClientActivation(int32 ReplicationID, int32 Slot, bool bNewSlot)
+{
+	if (!bEnabled)
+		return;
+	// Kept after lookup, every local client activate the same slot
+	if (auto AcquireTime = PendingAcquireTime.Find(MakeSlotKey(ReplicationID, Slot)))
+		(bNewSlot ? NewSlotLatencyMs : ActivationLatencyMs).Add((FPlatformTime::Seconds() - *AcquireTime) * 1000.0);
+}
+
+void FOtterPoolNetStats::RecordClientSlotCheck(bool bDesync)
+{
+	if (!bEnabled)
+		return;
+	NumSlotCheck++;
+	if (bDesync)
+		NumSlotDesync++;
+}
+
+bool FOtterPoolSoakBenchmark::ParseSettings(const FString& Cmd, FSettings& OutSettings)
+{
+	FString ClassPath;
+	if (!FParse::Value(*Cmd, TEXT("Class="), ClassPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Pool soak: missing Class=<ClassPath>"));
+		return false;
+	}
+	OutSettings.ActorClass = FSoftClassPath(ClassPath);
+	FParse::Value(*Cmd, TEXT("Population="), OutSettings.Population);
+	FParse::Value(*Cmd, TEXT("OpsPerSecond="), OutSettings.OpsPerSecond);
+	FParse::Value(*Cmd, TEXT("Seconds="), OutSettings.Duration);
+	FParse::Value(*Cmd, TEXT("PktLag="), OutSettings.PktLag);
+	FParse::Value(*Cmd, TEXT("PktLoss="), OutSettings.PktLoss);
+	FParse::Bool(*Cmd, TEXT("Quit="), OutSettings.bQuitWhenDone);
+	return true;
+}
+
+bool FOtterPoolSoakBenchmark::Start(const FSettings& InSettings)
+{
+	Stop();
+	LastReport.Empty();
+	ActiveBenchmark = new FOtterPoolSoakBenchmark(InSettings);
+	if (!ActiveBenchmark->bFinished)
+		return true;
+	Shutdown();
+	return false;
+}
+
+void FOtterPoolSoakBenchmark::Stop()
+{
+	if (ActiveBenchmark && !ActiveBenchmark->bFinished)
+		ActiveBenchmark->Finish();
+	Shutdown();
+}
+
+void FOtterPoolSoakBenchmark::Shutdown()
+{
+	delete ActiveBenchmark;
+	ActiveBenchmark = nullptr;
+}
+
+FOtterPoolSoakBenchmark::FOtterPoolSoakBenchmark(const FSettings& InSettings)
+	: Settings(InSettings)
+{
+	ActorClass = Settings.ActorClass.TryLoadClass<AActor>();
+	if (!ActorClass || !FindServerWorld())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Pool soak: need a valid actor class and a listen or dedicated server world, class %s"), *Settings.ActorClass.ToString());
+		bFinished = true;
+		return;
+	}
+
+	auto PktLag = IConsoleManager::Get().FindConsoleVariable(TEXT("NetEmulation.PktLag"));
+	auto PktLoss = IConsoleManager::Get().FindConsoleVariable(TEXT("NetEmulation.PktLoss"));
+	PrevPktLag = PktLag ? PktLag->GetString() : FString();
+	PrevPktLoss = PktLoss ? PktLoss->GetString() : FString();
+	SetNetEmulation(FString::FromInt(Settings.PktLag), FString::FromInt(Settings.PktLoss));
+
+	FOtterPoolNetStats::Get().Reset();
+	FOtterPoolNetStats::Get().ActorClass = ActorClass;
+	FOtterPoolNetStats::Get().bEnabled = true;
+	SnapshotServerOutBytes(FindServerWorld());
+	TickHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FOtterPoolSoakBenchmark::Tick));
+	UE_LOG(LogTemp, Log, TEXT("Pool soak: start %s population %d, %.1f op/s for %.1fs, lag %dms loss %d%%, %d client"),
+		*GetNameSafe(ActorClass), Settings.Population, Settings.OpsPerSecond, Settings.Duration, Settings.PktLag, Settings.PktLoss, GetNumClientWorld());
+}
+
+FOtterPoolSoakBenchmark::~FOtterPoolSoakBenchmark()
+{
+	FOtterPoolNetStats::Get().bEnabled = false;
+	if (TickHandle.IsValid())
+		FTSTicker::GetCoreTicker().RemoveTicker(TickHandle);
+}
+
+bool FOtterPoolSoakBenchmark::Tick(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FOtterPoolSoakBenchmark::Tick);
+	auto ServerWorld = FindServerWorld();
+	ElapsedTime += DeltaTime;
+	if (!ServerWorld || ElapsedTime >= Settings.Duration)
+	{
+		Finish();
+		// Ticker drop this delegate when false is returned, nothing touch this after delete
+		TickHandle.Reset();
+		if (ActiveBenchmark == this)
+			ActiveBenchmark = nullptr;
+		delete this;
+		return false;
+	}
+
+	OpAccumulator += DeltaTime * Settings.OpsPerSecond;
+	Churn(ServerWorld);
+
+	DesyncCheckAccumulator += DeltaTime;
+	if (DesyncCheckAccumulator >= 0.1f)
+	{
+		DesyncCheckAccumulator = 0.0f;
+		CheckClientDesync();
+	}
+	return true;
+}
+
+void FOtterPoolSoakBenchmark::Finish()
+{
+	bFinished = true;
+	for (auto& Actor : LiveActors)
+	{
+		if (Actor.IsValid())
+			UOtterPoolActorFunctionLibrary::DestroyActorFromPool(Actor.Get());
+	}
+	LiveActors.Empty();
+	if (!ActorClass)
+		return;
+
+	for (auto& Start : StartOutBytes)
+	{
+		// Connections that left during the run are dropped, joined ones were not measured from the start
+		if (auto Connection = Start.Key.Get())
+		{
+			ServerOutBytes += int64(Connection->OutTotalBytes) - Start.Value;
+			NumMeasuredConnection++;
+		}
+	}
+	Report();
+	FOtterPoolNetStats::Get().bEnabled = false;
+	SetNetEmulation(PrevPktLag, PrevPktLoss);
+	if (Settings.bQuitWhenDone)
+		FPlatformMisc::RequestExit(false);
+}
+
+void FOtterPoolSoakBenchmark::Churn(UWorld* ServerWorld)
+{
+	while (OpAccumulator >= 1.0f)
+	{
+		OpAccumulator -= 1.0f;
+		LiveActors.RemoveAllSwap([](const TWeakObjectPtr<AActor>& Actor) { return !Actor.IsValid(); });
+
+		// Hover around the target population, random op in between
+		const bool bRelease = LiveActors.Num() >= Settings.Population
+			|| (LiveActors.Num() > Settings.Population / 2 && FMath::RandBool());
+		if (bRelease)
+		{
+			const int32 Index = FMath::RandHelper(LiveActors.Num());
+			UOtterPoolActorFunctionLibrary::DestroyActorFromPool(LiveActors[Index].Get());
+			LiveActors.RemoveAtSwap(Index);
+		}
+		else
+		{
+			const FTransform SpawnTransform(FVector(FMath::FRandRange(-2000.0f, 2000.0f), FMath::FRandRange(-2000.0f, 2000.0f), 100.0f));
+			if (auto Actor = UOtterPoolActorFunctionLibrary::SpawnActorFromPool(ServerWorld, ActorClass, SpawnTransform, nullptr, nullptr))
+				LiveActors.Add(Actor);
+		}
+	}
+}
+
+void FOtterPoolSoakBenchmark::CheckClientDesync()
+{
+	auto& Stats = FOtterPoolNetStats::Get();
+	for (const FWorldContext& Context : GEngine->GetWorldContexts())
+	{
+		UWorld* World = Context.World();
+		if (!World || World->GetNetMode() != NM_Client)
+			continue;
+		for (TActorIterator<AReplicateProxyActor> It(World); It; ++It)
+		{
+			for (const auto& ActorEntry : It->GetActorPools().Items)
+			{
+				if (ActorEntry.ActorClass != ActorClass)
+					continue;
+				for (int32 Index = 0; Index < ActorEntry.CacheActors.Num(); Index++)
+				{
+					auto CacheActor = ActorEntry.CacheActors[Index].Actor;
+					if (!IsValid(CacheActor))
+						continue;
+					const bool bUsed = (ActorEntry.UsingBit >> Index) & 1;
+					Stats.RecordClientSlotCheck(bUsed == CacheActor->IsHidden());
+				}
+			}
+		}
+	}
+}
+
+void FOtterPoolSoakBenchmark::Report()
+{
+	auto& Stats = FOtterPoolNetStats::Get();
+	const int32 NumLocalClient = GetNumClientWorld();
+	const int32 NumClient = FMath::Max(NumLocalClient, 1);
+	const int64 NumOp = FMath::Max<int64>(Stats.NumAcquire + Stats.NumRelease, 1);
+	const double SerializeMs = FPlatformTime::ToMilliseconds64(Stats.SerializeCycles);
+	const bool bHasLocalClient = NumLocalClient > 0;
+	const int64 NumReuseAcquire = Stats.NumAcquire - Stats.NumNewSlotAcquire;
+
+	auto Latency = Stats.ActivationLatencyMs;
+	Latency.Sort();
+	auto NewSlotLatency = Stats.NewSlotLatencyMs;
+	NewSlotLatency.Sort();
+	auto Percentile = [](const TArray<double>& Samples, float Ratio)
+		{
+			return Samples.IsEmpty() ? 0.0 : Samples[FMath::Min(FMath::FloorToInt(Samples.Num() * Ratio), Samples.Num() - 1)];
+		};
+
+	TArray<TPair<FString, FString>> Rows;
+	Rows.Emplace(TEXT("Class"), GetNameSafe(ActorClass));
+	// Acquires, releases, latency and desync are filtered by Class, bytes and CPU are not
+	Rows.Emplace(TEXT("BytesAndCpuScope"), TEXT("whole map"));
+	Rows.Emplace(TEXT("Clients"), FString::FromInt(NumLocalClient));
+	Rows.Emplace(TEXT("ServerConnections"), FString::FromInt(NumMeasuredConnection));
+	Rows.Emplace(TEXT("PktLagMs"), FString::FromInt(Settings.PktLag));
+	Rows.Emplace(TEXT("PktLossPercent"), FString::FromInt(Settings.PktLoss));
+	Rows.Emplace(TEXT("Acquires"), LexToString(Stats.NumAcquire));
+	Rows.Emplace(TEXT("NewSlotAcquires"), LexToString(Stats.NumNewSlotAcquire));
+	Rows.Emplace(TEXT("Releases"), LexToString(Stats.NumRelease));
+	// Everything the server sent on its connections: pooled actor channels (dormancy wake, ForceNetUpdate,
+	// transform and property resend), proxy arrays, resends of emulated loss and any other traffic of the map
+	Rows.Emplace(TEXT("ServerOutBytesPerOpPerConnection"), NumMeasuredConnection > 0 ? FString::SanitizeFloat(double(ServerOutBytes) / NumOp / NumMeasuredConnection) : TEXT("n/a"));
+	Rows.Emplace(TEXT("ServerOutBytesPerSecondPerConnection"), NumMeasuredConnection > 0 && ElapsedTime > 0.0f ? FString::SanitizeFloat(ServerOutBytes / ElapsedTime / NumMeasuredConnection) : TEXT("n/a"));
+	// Fast array serialize run once per connection, divide by client to get the cost of one connection.
+	// Only the proxy pool array, kept apart from the connection total to see array level changes
+	Rows.Emplace(TEXT("PoolArrayBytesPerOpPerClient"), FString::SanitizeFloat(Stats.PoolArrayBits / 8.0 / NumOp / NumClient));
+	Rows.Emplace(TEXT("StandInArrayBytesPerClient"), FString::SanitizeFloat(Stats.StandInArrayBits / 8.0 / NumClient));
+	Rows.Emplace(TEXT("ReplicationCpuMsTotal"), FString::SanitizeFloat(SerializeMs));
+	Rows.Emplace(TEXT("ReplicationCpuUsPerSerialize"), FString::SanitizeFloat(Stats.NumSerialize > 0 ? SerializeMs * 1000.0 / Stats.NumSerialize : 0.0));
+	// Latency and desync need the clients in this process
+	const FString NotMeasured = TEXT("n/a");
+	// Reused slots only, one sample per local client, coverage below 1 mean activations were missed
+	Rows.Emplace(TEXT("ActivationSamples"), FString::FromInt(Latency.Num()));
+	Rows.Emplace(TEXT("ActivationCoverage"), bHasLocalClient && NumReuseAcquire > 0 ? FString::SanitizeFloat(double(Latency.Num()) / (NumReuseAcquire * NumLocalClient)) : NotMeasured);
+	Rows.Emplace(TEXT("ActivationMsP50"), bHasLocalClient ? FString::SanitizeFloat(Percentile(Latency, 0.5f)) : NotMeasured);
+	Rows.Emplace(TEXT("ActivationMsP95"), bHasLocalClient ? FString::SanitizeFloat(Percentile(Latency, 0.95f)) : NotMeasured);
+	Rows.Emplace(TEXT("ActivationMsMax"), bHasLocalClient && !Latency.IsEmpty() ? FString::SanitizeFloat(Latency.Last()) : NotMeasured);
+	// Pool misses of the warm-up, time until the appended slot reach the client array
+	Rows.Emplace(TEXT("NewSlotSamples"), FString::FromInt(NewSlotLatency.Num()));
+	Rows.Emplace(TEXT("NewSlotCoverage"), bHasLocalClient && Stats.NumNewSlotAcquire > 0 ? FString::SanitizeFloat(double(NewSlotLatency.Num()) / (Stats.NumNewSlotAcquire * NumLocalClient)) : NotMeasured);
+	Rows.Emplace(TEXT("NewSlotMsP50"), bHasLocalClient ? FString::SanitizeFloat(Percentile(NewSlotLatency, 0.5f)) : NotMeasured);
+	Rows.Emplace(TEXT("NewSlotMsP95"), bHasLocalClient ? FString::SanitizeFloat(Percentile(NewSlotLatency, 0.95f)) : NotMeasured);
+	Rows.Emplace(TEXT("DesyncSlotChecks"), LexToString(Stats.NumSlotCheck));
+	Rows.Emplace(TEXT("DesyncSlots"), bHasLocalClient ? LexToString(Stats.NumSlotDesync) : NotMeasured);
+	LastReport = Rows;
+
+	FString Csv;
+	for (const auto& Row : Rows)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Pool soak: %s = %s"), *Row.Key, *Row.Value);
+		Csv += FString::Printf(TEXT("%s,%s\n"), *Row.Key, *Row.Value);
+	}
+	const FString Filename = FPaths::ProjectSavedDir() / FString::Printf(TEXT("OtterPool/Soak_%s_%s.csv"), *GetNameSafe(ActorClass), *FDateTime::Now().ToString());
+	if (FFileHelper::SaveStringToFile(Csv, *Filename))
+		UE_LOG(LogTemp, Log, TEXT("Pool soak: report written to %s"), *Filename);
+}
+
+void FOtterPoolSoakBenchmark::SetNetEmulation(const FString& PktLag, const FString& PktLoss)
+{
+	auto PktLagVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("NetEmulation.PktLag"));
+	auto PktLossVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("NetEmulation.PktLoss"));
+	if (!PktLagVariable || !PktLossVariable)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Pool soak: net emulation is not available in this build"));
+		return;
+	}
+	PktLagVariable->Set(*PktLag, ECVF_SetByConsole);
+	PktLossVariable->Set(*PktLoss, ECVF_SetByConsole);
+}
+
+void FOtterPoolSoakBenchmark::SnapshotServerOutBytes(UWorld* ServerWorld)
+{
+	StartOutBytes.Empty();
+	auto NetDriver = ServerWorld ? ServerWorld->GetNetDriver() : nullptr;
+	if (!NetDriver)
+		return;
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection)
+			StartOutBytes.Add(Connection, Connection->OutTotalBytes);
+	}
+}
+
+UWorld* FOtterPoolSoakBenchmark::FindServerWorld()
+{
+	for (const FWorldContext& Context : GEngine->GetWorldContexts())
+	{
+		UWorld* World = Context.World();
+		if (World && World->HasBegunPlay() && (World->GetNetMode() == NM_ListenServer || World->GetNetMode() == NM_DedicatedServer))
+			return World;
+	}
+	return nullptr;
+}
+
+int32 FOtterPoolSoakBenchmark::GetNumClientWorld()
+{
+	int32 NumClient = 0;
+	for (const FWorldContext& Context : GEngine->GetWorldContexts())
+	{
+		if (Context.World() && Context.World()->HasBegunPlay() && Context.World()->GetNetMode() == NM_Client)
+			NumClient++;
+	}
+	return NumClient;
+}
+
+#endif
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "UObject/SoftObjectPath.h"
+
+#ifndef OTTER_POOL_NET_STATS
+#define OTTER_POOL_NET_STATS !UE_BUILD_SHIPPING
+#endif
+
+#if OTTER_POOL_NET_STATS
+
+class UNetConnection;
+
+/**
+ * Process wide counters filled by the pool replication path while a soak benchmark is running.
+ * Server and clients must run in one process (PIE run under one process), latency and desync
+ * can not be measured across processes.
+ */
+struct FOtterPoolNetStats
+{
+	static FOtterPoolNetStats& Get();
+
+	void Reset();
+	void RecordServerAcquire(UClass* InActorClass, int32 ReplicationID, int32 Slot, bool bNewSlot);
+	void RecordServerRelease(UClass* InActorClass);
+	void RecordServerSerialize(int64 NumBits, uint64 Cycles, bool bStandIn);
+	void RecordClientActivation(int32 ReplicationID, int32 Slot, bool bNewSlot);
+	void RecordClientSlotCheck(bool bDesync);
+
+	bool bEnabled = false;
+	// Acquire, release and latency only count this class, fast array bits and CPU cover every pooled class
+	UClass* ActorClass = nullptr;
+	int64 NumAcquire = 0;
+	int64 NumNewSlotAcquire = 0; // Pool miss, the acquire append a slot instead of reusing one
+	int64 NumRelease = 0;
+	int64 NumSerialize = 0;
+	int64 PoolArrayBits = 0;
+	int64 StandInArrayBits = 0;
+	uint64 SerializeCycles = 0;
+	int64 NumSlotCheck = 0;
+	int64 NumSlotDesync = 0;
+	TArray<double> ActivationLatencyMs; // Reused slot, client PostReplicatedChange activate the actor
+	TArray<double> NewSlotLatencyMs; // Appended slot reach the client array, the actor itself come with its channel
+
+private:
+	static uint64 MakeSlotKey(int32 ReplicationID, int32 Slot) { return (uint64(uint32(ReplicationID)) << 8) | uint8(Slot); }
+
+	// Server acquire time of each entry slot, fast array ReplicationID is the same on server and client
+	TMap<uint64, double> PendingAcquireTime;
+};
+
+/**
+ * Drive acquire/release churn on the server world with packet lag/loss emulation and report
+ * pool array bytes per operation, proxy replication CPU, acquire to client activation latency and client desyncs.
+ * Run by the OtterPool.Soak automation test, or by hand with Otter.Pool.Soak in an already running PIE session.
+ */
+class FOtterPoolSoakBenchmark
+{
+public:
+	struct FSettings
+	{
+		FSoftClassPath ActorClass;
+		int32 Population = 32;
+		float OpsPerSecond = 60.0f;
+		float Duration = 30.0f;
+		int32 PktLag = 100;
+		int32 PktLoss = 2;
+		bool bQuitWhenDone = false;
+	};
+
+	static bool ParseSettings(const FString& Cmd, FSettings& OutSettings);
+	static bool Start(const FSettings& InSettings);
+	static bool IsRunning() { return ActiveBenchmark != nullptr; }
+	// Finish and report the running benchmark
+	static void Stop();
+	// Free the running benchmark without touching worlds, for module shutdown
+	static void Shutdown();
+	static const TArray<TPair<FString, FString>>& GetLastReport() { return LastReport; }
+
+	static UWorld* FindServerWorld();
+	static int32 GetNumClientWorld();
+
+	explicit FOtterPoolSoakBenchmark(const FSettings& InSettings);
+	~FOtterPoolSoakBenchmark();
+
+private:
+	bool Tick(float DeltaTime);
+	void Finish();
+	void Churn(UWorld* ServerWorld);
+	void CheckClientDesync();
+	void Report();
+	void SetNetEmulation(const FString& PktLag, const FString& PktLoss);
+	void SnapshotServerOutBytes(UWorld* ServerWorld);
+
+	FSettings Settings;
+	UClass* ActorClass = nullptr;
+	TArray<TWeakObjectPtr<AActor>> LiveActors;
+	FTSTicker::FDelegateHandle TickHandle;
+	float ElapsedTime = 0.0f;
+	float OpAccumulator = 0.0f;
+	float DesyncCheckAccumulator = 0.0f;
+	bool bFinished = false;
+	FString PrevPktLag;
+	FString PrevPktLoss;
+
+	// Server connection outgoing bytes at start, delta over the run measured in Finish
+	TMap<TWeakObjectPtr<UNetConnection>, int64> StartOutBytes;
+	int64 ServerOutBytes = 0;
+	int32 NumMeasuredConnection = 0;
+
+	static FOtterPoolSoakBenchmark* ActiveBenchmark;
+	static TArray<TPair<FString, FString>> LastReport;
+};
+
+#endif
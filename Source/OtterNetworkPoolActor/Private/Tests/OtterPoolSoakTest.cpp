@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "OtterPoolSoakBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_EDITOR && OTTER_POOL_NET_STATS
+
+#include "Misc/AutomationTest.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Editor.h"
+#include "Settings/LevelEditorPlaySettings.h"
+#include "Tests/AutomationCommon.h"
+#include "Tests/AutomationEditorCommon.h"
+
+/**
+ * Start a listen server PIE session with clients under one process, required by FOtterPoolNetStats
+ */
+class FOtterPoolStartPIECommand : public IAutomationLatentCommand
+{
+public:
+	explicit FOtterPoolStartPIECommand(int32 InNumClients) : NumClients(InNumClients) {}
+
+	virtual bool Update() override
+	{
+		ULevelEditorPlaySettings* PlaySettings = NewObject<ULevelEditorPlaySettings>();
+		PlaySettings->SetPlayNetMode(EPlayNetMode::PIE_ListenServer);
+		PlaySettings->SetPlayNumberOfClients(NumClients + 1); // Listen server count as a player
+		PlaySettings->SetRunUnderOneProcess(true);
+
+		FRequestPlaySessionParams Params;
+		Params.WorldType = EPlaySessionWorldType::PlayInEditor;
+		Params.EditorPlaySettings = PlaySettings;
+		GEditor->RequestPlaySession(Params);
+		return true;
+	}
+
+private:
+	int32 NumClients;
+};
+
+class FOtterPoolWaitForWorldsCommand : public IAutomationLatentCommand
+{
+public:
+	FOtterPoolWaitForWorldsCommand(FAutomationTestBase* InTest, int32 InNumClients) : Test(InTest), NumClients(InNumClients) {}
+
+	virtual bool Update() override
+	{
+		if (FOtterPoolSoakBenchmark::FindServerWorld() && FOtterPoolSoakBenchmark::GetNumClientWorld() >= NumClients)
+			return true;
+		if (GetCurrentRunTime() > 60.0)
+		{
+			Test->AddError(FString::Printf(TEXT("Server and %d client worlds did not begin play"), NumClients));
+			return true;
+		}
+		return false;
+	}
+
+private:
+	FAutomationTestBase* Test;
+	int32 NumClients;
+};
+
+class FOtterPoolRunSoakCommand : public IAutomationLatentCommand
+{
+public:
+	FOtterPoolRunSoakCommand(FAutomationTestBase* InTest, const FOtterPoolSoakBenchmark::FSettings& InSettings) : Test(InTest), Settings(InSettings) {}
+
+	virtual bool Update() override
+	{
+		if (!bStarted)
+		{
+			bStarted = true;
+			if (!FOtterPoolSoakBenchmark::Start(Settings))
+			{
+				Test->AddError(TEXT("Soak benchmark could not start"));
+				return true;
+			}
+			return false;
+		}
+		if (FOtterPoolSoakBenchmark::IsRunning())
+			return false;
+
+		for (const auto& Row : FOtterPoolSoakBenchmark::GetLastReport())
+			Test->AddInfo(FString::Printf(TEXT("%s = %s"), *Row.Key, *Row.Value));
+		if (FOtterPoolNetStats::Get().NumAcquire == 0)
+			Test->AddError(TEXT("Soak benchmark did not acquire any actor"));
+		return true;
+	}
+
+private:
+	FAutomationTestBase* Test;
+	FOtterPoolSoakBenchmark::FSettings Settings;
+	bool bStarted = false;
+};
+
+/**
+ * One test per +Run line of [OtterPoolSoak] in Game.ini, same arguments as Otter.Pool.Soak plus Map and Clients:
+ * +Run=Map=/Game/Maps/Soak Class=/Game/BP_Debris.BP_Debris_C Clients=3 Population=64 Seconds=60 PktLag=120 PktLoss=3
+ */
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FOtterPoolSoakTest, "OtterPool.Soak", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+void FOtterPoolSoakTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	TArray<FString> Runs;
+	GConfig->GetArray(TEXT("OtterPoolSoak"), TEXT("Run"), Runs, GGameIni);
+	for (int32 Index = 0; Index < Runs.Num(); Index++)
+	{
+		FString Map;
+		FString ClassPath;
+		FParse::Value(*Runs[Index], TEXT("Map="), Map);
+		FParse::Value(*Runs[Index], TEXT("Class="), ClassPath);
+		OutBeautifiedNames.Add(FString::Printf(TEXT("%d_%s_%s"), Index, *FPaths::GetBaseFilename(Map), *FPaths::GetExtension(ClassPath)));
+		OutTestCommands.Add(Runs[Index]);
+	}
+}
+
+bool FOtterPoolSoakTest::RunTest(const FString& Parameters)
+{
+	FOtterPoolSoakBenchmark::FSettings Settings;
+	FString Map;
+	int32 NumClients = 2;
+	if (!FParse::Value(*Parameters, TEXT("Map="), Map) || !FOtterPoolSoakBenchmark::ParseSettings(Parameters, Settings))
+	{
+		AddError(FString::Printf(TEXT("Invalid soak run '%s', need Map= and Class="), *Parameters));
+		return false;
+	}
+	FParse::Value(*Parameters, TEXT("Clients="), NumClients);
+	Settings.bQuitWhenDone = false;
+
+	FAutomationEditorCommonUtils::LoadMap(Map);
+	ADD_LATENT_AUTOMATION_COMMAND(FOtterPoolStartPIECommand(NumClients));
+	ADD_LATENT_AUTOMATION_COMMAND(FOtterPoolWaitForWorldsCommand(this, NumClients));
+	ADD_LATENT_AUTOMATION_COMMAND(FOtterPoolRunSoakCommand(this, Settings));
+	ADD_LATENT_AUTOMATION_COMMAND(FEndPlayMapCommand());
+	return true;
+}
+
+#endif
@@ -5,9 +5,12 @@
 #include "CoreMinimal.h"
 #include "Subsystems/WorldSubsystem.h"
 #include "Net/Serialization/FastArraySerializer.h"
+#include "Engine/NetSerialization.h"
 #include "OtterActorPoolWorldSubsystem.generated.h"
 
 class AReplicateProxyActor;
+class UInstancedStaticMeshComponent;
+class UPrimitiveComponent;
 
 DECLARE_DELEGATE_OneParam(FOtterPoolPreBeginPlay, AActor*);
 
@@ -53,17 +56,25 @@ struct FOtterPoolActorEntry : public FFastArraySerializerItem
 	uint64 UsingBit = 0; // 64 bit, max 64 actor support
 
 	uint64 CacheClientUsingBit = 0;
+	uint64 ClientTickDisabledBit = 0; // Slots whose actor tick has been disabled for batched tick on client
 	uint8 NumActor;
 
 	bool bStartWithTickEnable = false;
+	bool bBatchedTick = false;
 
 	bool IsFull() const;
 	FOtterActorPoolData* FindUnusedActor();
 	FOtterActorPoolData* SpawnActor(UWorld* InWorld, const FPoolActorSpawnParameters& SpawnParameter, bool bUsedNow = true);
+	// Spawn and set up a new actor for the pool, shared by entry slots and over cap actors
+	static AActor* SpawnPoolActor(UWorld* InWorld, const FPoolActorSpawnParameters& SpawnParameter, bool bBatchedTick);
+	static bool UseBatchedTick(TSubclassOf<AActor> ActorClass);
+	static void DisableBatchedActorTick(AActor* InActor);
 	bool PushToPool(AActor* InActor);
 	void SetSlot(int Index, bool bUsed);
 	void OnActorEndPlay(AActor* InActor);
 	void SetComponentTick(AActor* InActor, bool bEnable);
+	void InitBatchedTick();
+	void DisableResolvedBatchedTick();
 
 	void PreReplicatedRemove(const struct FOtterPoolActorArray& InArraySerializer) {};
 	void PostReplicatedAdd(const struct FOtterPoolActorArray& InArraySerializer);
@@ -89,10 +100,7 @@ public:
 	//~FFastArraySerializer contract
 	void PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize) {};
 	void PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize);
-	bool NetDeltaSerialize(FNetDeltaSerializeInfo & DeltaParms)
-	{
-		return FFastArraySerializer::FastArrayDeltaSerialize<FOtterPoolActorEntry, FOtterPoolActorArray>(Items, DeltaParms, *this );
-	}
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo & DeltaParms);
 	//~End of FFastArraySerializer contract
 
 	UPROPERTY(Transient)
@@ -110,6 +118,139 @@ struct TStructOpsTypeTraits<FOtterPoolActorArray> : public TStructOpsTypeTraitsB
 	};
 };
 
+// Usage of one class over the session, recorded on server for the sizing report
+struct FOtterPoolClassUsage
+{
+	int32 PeakInUse = 0;
+	int32 NumAcquire = 0;
+	int32 NumMiss = 0;
+	int32 NumOverCap = 0;
+	double SpawnSeconds = 0.0;
+
+	// Live actors spawned without pool because the cap was reached
+	TArray<TWeakObjectPtr<AActor>> OverCapActors;
+};
+
+// One line of the sizing config, recommended from FOtterPoolClassUsage and applied on world begin play
+USTRUCT()
+struct FOtterPoolClassSizing
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TSoftClassPtr<AActor> ActorClass;
+
+	UPROPERTY()
+	int32 WarmCount = 0;
+
+	UPROPERTY()
+	int32 MaxCount = 0; // 0 mean no cap
+
+	UPROPERTY()
+	int32 PeakInUse = 0;
+
+	UPROPERTY()
+	int32 NumAcquire = 0;
+
+	UPROPERTY()
+	int32 NumMiss = 0;
+
+	UPROPERTY()
+	int32 NumOverCap = 0;
+
+	UPROPERTY()
+	float AvgSpawnMs = 0.0f;
+};
+
+USTRUCT()
+struct FOtterPoolStandInItem : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Handle = INDEX_NONE; // INDEX_NONE mean free item, reused by the next stand-in
+
+	UPROPERTY()
+	TSubclassOf<AActor> ActorClass;
+
+	UPROPERTY()
+	FVector_NetQuantize10 Location;
+	UPROPERTY()
+	FRotator Rotation = FRotator::ZeroRotator;
+	UPROPERTY()
+	FVector_NetQuantize100 Scale = FVector::OneVector;
+
+	// Instance currently shown for this item on client
+	int32 ClientHandle = INDEX_NONE;
+	UClass* ClientActorClass = nullptr;
+
+	bool IsActive() const { return Handle != INDEX_NONE; }
+	FTransform GetTransform() const;
+	void SetTransform(const FTransform& Transform);
+
+	void PreReplicatedRemove(const struct FOtterPoolStandInArray& InArraySerializer);
+	void PostReplicatedAdd(const struct FOtterPoolStandInArray& InArraySerializer);
+	void PostReplicatedChange(const struct FOtterPoolStandInArray& InArraySerializer);
+};
+
+USTRUCT()
+struct OTTERNETWORKPOOLACTOR_API FOtterPoolStandInArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+	TArray<FOtterPoolStandInItem> Items;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo & DeltaParms);
+
+	UPROPERTY(Transient)
+	TWeakObjectPtr<AReplicateProxyActor> Owner;
+};
+
+template<>
+struct TStructOpsTypeTraits<FOtterPoolStandInArray> : public TStructOpsTypeTraitsBase2<FOtterPoolStandInArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+USTRUCT()
+struct FOtterPoolStandInBatch
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent* Component = nullptr;
+
+	// Stand-in handle of each instance, same order as Component instances
+	TArray<int32> Handles;
+};
+
+USTRUCT()
+struct FOtterPoolBatchTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TSubclassOf<AActor> ActorClass;
+
+	TWeakObjectPtr<AReplicateProxyActor> Owner;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FOtterPoolBatchTickFunction> : public TStructOpsTypeTraitsBase2<FOtterPoolBatchTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
 UCLASS()
 class AReplicateProxyActor : public AInfo
 {
@@ -117,6 +258,7 @@ class AReplicateProxyActor : public AInfo
 public:
 	AReplicateProxyActor();
 
+	virtual void PostInitProperties() override;
 	void EndPlay(EEndPlayReason::Type Reason);
 
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty> &OutLifetimeProps) const;
@@ -131,9 +273,64 @@ public:
 
 	bool ReleaseToPool(AActor* Actor);
 
+	int32 AddStandIn(TSubclassOf<AActor> ActorClass, FTransform const& Transform);
+	AActor* PromoteStandIn(int32 Handle, AActor* Owner = nullptr, APawn* Instigator = nullptr);
+	int32 DemoteToStandIn(AActor* Actor);
+	bool RemoveStandIn(int32 Handle);
+	int32 FindStandIns(TSubclassOf<AActor> ActorClass, const FVector& Location, float Radius, TArray<int32>& OutHandles) const;
+	int32 GetStandInHandle(const UPrimitiveComponent* Component, int32 InstanceIndex) const;
+
+	void AddStandInInstance(UClass* ActorClass, int32 Handle, const FTransform& Transform);
+	void RemoveStandInInstance(UClass* ActorClass, int32 Handle);
+
+	void RegisterBatchedTick(TSubclassOf<AActor> ActorClass);
+	void TickBatched(TSubclassOf<AActor> ActorClass, float DeltaTime);
+
+	// Cap the number of cached actor of the class and spawn unused actors up to WarmCount, once the world has begun play
+	void ApplySizing(TSubclassOf<AActor> ActorClass, int32 WarmCount, int32 MaxCount);
+	const TMap<UClass*, FOtterPoolClassUsage>& GetClassUsage() const { return ClassUsage; }
+	int32 GetNumCachedActor(TSubclassOf<AActor> ActorClass) const;
+	const FOtterPoolActorArray& GetActorPools() const { return ActorPools; }
+
 protected:
+	FOtterPoolActorEntry& AddEntry(TSubclassOf<AActor> ActorClass);
+	void FreeStandIn(int32 ItemIndex);
+	void AddStandInToCell(int32 ItemIndex);
+	void RemoveStandInFromCell(int32 ItemIndex);
+	int32 GetNumInUse(TSubclassOf<AActor> ActorClass) const;
+	bool HasReachedMaxCount(TSubclassOf<AActor> ActorClass) const;
+	AActor* SpawnOverCapActor(const FPoolActorSpawnParameters& SpawnParameter, double StartTime);
+	void RecordAcquire(const FOtterPoolActorEntry& AcquireEntry, const FOtterActorPoolData* ActorData, bool bMiss, double SpawnSeconds);
+	void RecordUsage(TSubclassOf<AActor> ActorClass, bool bMiss, double SpawnSeconds);
+
 	UPROPERTY(Replicated)
 	FOtterPoolActorArray ActorPools;
+
+	// One tick function per class using IOtterPoolActorInterface::UsePoolBatchedTick
+	TArray<TUniquePtr<FOtterPoolBatchTickFunction>> BatchedTickFunctions;
+
+	UPROPERTY(Replicated)
+	FOtterPoolStandInArray StandIns;
+
+	// Local render side of StandIns, not created on dedicated server
+	UPROPERTY(Transient)
+	TMap<UClass*, FOtterPoolStandInBatch> StandInBatches;
+
+	// Stand-in handle to instance index in its batch
+	TMap<int32, int32> StandInInstanceIndices;
+
+	// Server only, stand-in handle to index in StandIns.Items and items free to reuse
+	TMap<int32, int32> StandInItemIndices;
+	TArray<int32> FreeStandInItems;
+
+	// Server only, per-class spatial hash of StandIns.Items indices for FindStandIns
+	TMap<UClass*, TMap<FIntVector, TArray<int32>>> StandInCells;
+
+	int32 NextStandInHandle = 0;
+	bool bWarnedStandInCap = false;
+
+	TMap<UClass*, FOtterPoolClassUsage> ClassUsage;
+	TMap<UClass*, int32> ClassMaxCount;
 };
 
 /**
@@ -159,7 +356,23 @@ public:
 
 	bool ReleaseToPool(AActor* Actor);
 
+	int32 AddStandIn(TSubclassOf<AActor> ActorClass, FTransform const& Transform);
+	AActor* PromoteStandIn(int32 Handle, AActor* Owner = nullptr, APawn* Instigator = nullptr);
+	int32 DemoteToStandIn(AActor* Actor);
+	bool RemoveStandIn(int32 Handle);
+	int32 FindStandIns(TSubclassOf<AActor> ActorClass, const FVector& Location, float Radius, TArray<int32>& OutHandles) const;
+	int32 GetStandInHandle(const UPrimitiveComponent* Component, int32 InstanceIndex) const;
+
+	// Write recommended warm counts and caps from this session usage to Saved/OtterPool/OtterPoolSizing.<Map>.ini,
+	// paste its [OtterPoolSizing.<Map>] section into Config/DefaultGame.ini to have it applied on next world begin play
+	bool WriteSizingReport();
+
 protected:
+	void ApplySizingConfig();
+	FString GetSizingSectionName() const;
+
 	UPROPERTY()
 	AReplicateProxyActor* ReplicateActor;
+
+	FDelegateHandle WorldBeginPlayHandle;
 };
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include "Engine/HitResult.h"
 #include "OtterPoolActorFunctionLibrary.generated.h"
 
 /**
@@ -20,4 +21,17 @@ public:
 	static AActor* SpawnActorFromPool(UObject* WorldContextObject, TSubclassOf<AActor> ActorClass, const FTransform& SpawnTransform, AActor* OwnerActor, APawn* Instigator);
 	UFUNCTION(BlueprintCallable, Category="Otter|Pool", meta=(WorldContext = "WorldContextObject"))
 	static bool DestroyActorFromPool(AActor* ActorToDestroy);
+
+	UFUNCTION(BlueprintCallable, Category="Otter|Pool", meta=(WorldContext = "WorldContextObject"))
+	static int32 AddStandInToPool(UObject* WorldContextObject, TSubclassOf<AActor> ActorClass, const FTransform& SpawnTransform);
+	UFUNCTION(BlueprintCallable, Category="Otter|Pool", meta=(WorldContext = "WorldContextObject"))
+	static AActor* PromoteStandInFromPool(UObject* WorldContextObject, int32 StandInHandle, AActor* OwnerActor, APawn* Instigator);
+	UFUNCTION(BlueprintCallable, Category="Otter|Pool")
+	static int32 DemoteActorToStandIn(AActor* ActorToDemote);
+	UFUNCTION(BlueprintCallable, Category="Otter|Pool", meta=(WorldContext = "WorldContextObject"))
+	static bool RemoveStandInFromPool(UObject* WorldContextObject, int32 StandInHandle);
+	UFUNCTION(BlueprintCallable, Category="Otter|Pool", meta=(WorldContext = "WorldContextObject"))
+	static int32 FindStandInsInPool(UObject* WorldContextObject, TSubclassOf<AActor> ActorClass, FVector Location, float Radius, TArray<int32>& OutStandInHandles);
+	UFUNCTION(BlueprintPure, Category="Otter|Pool", meta=(WorldContext = "WorldContextObject"))
+	static int32 GetStandInHandleFromHit(UObject* WorldContextObject, const FHitResult& Hit);
 };
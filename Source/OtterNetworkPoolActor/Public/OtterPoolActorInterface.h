@@ -7,6 +7,9 @@
 
 #include "OtterPoolActorInterface.generated.h"
 
+class UStaticMesh;
+class UActorComponent;
+
 // This class does not need to be modified.
 UINTERFACE(MinimalAPI, meta=(CannotImplementInterfaceInBlueprint))
 class UOtterPoolActorInterface : public UInterface
@@ -30,6 +33,22 @@ public:
 	virtual void CollectProperty(AActor* Self, UClass* RootClass);
 	virtual void ResetProperty(AActor* Self);
 
+	// Opt-in batched tick: queried on the class CDO, the actor tick is never enabled, the pool call OnPoolTick
+	// for every active actor of the class from a single tick function instead, on server over cap actors included.
+	// Components keep their own tick (animation, FX, movement...) unless ShouldPoolBatchComponentTick return true
+	// for them, those are turned off for good and OnPoolTick must drive them
+	virtual bool UsePoolBatchedTick() const { return false; }
+	virtual bool ShouldPoolBatchComponentTick(const UActorComponent* Component) const { return false; }
+	virtual void OnPoolTick(AActor* Self, float DeltaTime) {}
+
+	// Stand-in mode: queried on the class CDO, when not null idle instances can live as entries of a per-class
+	// instanced static mesh and only become a real pooled actor when promoted
+	virtual UStaticMesh* GetPoolStandInMesh() const { return nullptr; }
+	// Stand-in instances have no collision unless a profile is returned, keep it query only on a channel used by
+	// interaction traces. Only clients and listen host get collision, the dedicated server has no stand-in mesh,
+	// confirm a hit with FindStandInsInPool on server
+	virtual FName GetPoolStandInCollisionProfile() const { return NAME_None; }
+
 private:
 	bool bEnable = false;
 